@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief nanoseconds the callers of a group of readers/writers spent blocked on their disk threads
+using IoWaitCounter = std::atomic<std::uint64_t>;
+
+/// @brief waits on `cv` until `ready`, adding the blocked time to `counter` if there is one
+template <typename Ready>
+void WaitCounted(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, IoWaitCounter* counter, Ready ready) {
+    if (counter == nullptr || ready()) {
+        cv.wait(lock, ready);
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    cv.wait(lock, ready);
+    *counter += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief read-ahead reader: a dedicated thread keeps up to `depth` blocks of the file loaded
+/// while the caller consumes the current one, so parsing/compare work overlaps with the disk.
+/// Reads the byte range [offset, offset + length) of the file.
+class AsyncReader {
+private:
+    struct Block {
+        std::vector<char> data;
+        std::size_t size = 0;
+    };
+
+    std::ifstream _file;
+    std::uint64_t _left;
+    std::vector<Block> _blocks;
+    std::size_t _head, _count;
+    bool _eof, _stop, _holding;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _worker;
+
+    const char* _data;
+    std::size_t _pos, _size;
+    IoWaitCounter* _wait;
+
+    void Work() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _cv.wait(lock, [this] { return _stop || _count < _blocks.size(); });
+            if (_stop) {
+                return;
+            }
+            Block& block = _blocks[(_head + _count) % _blocks.size()];
+            lock.unlock();
+            std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(block.data.size(), _left));
+            _file.read(block.data.data(), want);
+            block.size = static_cast<std::size_t>(_file.gcount());
+            _left -= block.size;
+            lock.lock();
+            if (block.size == 0) {
+                _eof = true;
+                _cv.notify_all();
+                return;
+            }
+            ++_count;
+            _cv.notify_all();
+        }
+    }
+
+    bool NextBlock() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_holding) {
+            _head = (_head + 1) % _blocks.size();
+            --_count;
+            _holding = false;
+            _cv.notify_all();
+        }
+        WaitCounted(_cv, lock, _wait, [this] { return _count > 0 || _eof; });
+        if (_count == 0) {
+            _data = nullptr;
+            _pos = _size = 0;
+            return false;
+        }
+        _holding = true;
+        _data = _blocks[_head].data.data();
+        _size = _blocks[_head].size;
+        _pos = 0;
+        return true;
+    }
+
+public:
+    AsyncReader(const std::string& fileName, std::size_t blockSize, std::size_t depth = 2,
+                std::uint64_t offset = 0, std::uint64_t length = std::numeric_limits<std::uint64_t>::max())
+        : _file(fileName, std::ios::binary), _left(length), _blocks(std::max<std::size_t>(depth, 2)),
+          _head(0), _count(0), _eof(false), _stop(false), _holding(false), _data(nullptr), _pos(0), _size(0), _wait(nullptr) {
+        for (auto& block : _blocks) {
+            block.data.resize(blockSize);
+        }
+        if (offset > 0) {
+            _file.seekg(static_cast<std::streamoff>(offset));
+        }
+        _worker = std::thread(&AsyncReader::Work, this);
+    }
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    /// @brief time spent waiting for blocks is added to `counter` from now on
+    void CountWait(IoWaitCounter* counter) {
+        _wait = counter;
+    }
+
+    ~AsyncReader() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _worker.join();
+    }
+
+    /// @brief copies up to `bytes` bytes, returns fewer only at the end of the range
+    std::size_t Read(char* dst, std::size_t bytes) {
+        std::size_t done = 0;
+        while (done < bytes) {
+            if (_pos == _size && !NextBlock()) {
+                break;
+            }
+            std::size_t n = std::min(bytes - done, _size - _pos);
+            std::memcpy(dst + done, _data + _pos, n);
+            _pos += n;
+            done += n;
+        }
+        return done;
+    }
+
+    /// @brief zero-copy access to the rest of the current block, or to the next one
+    bool ReadBlock(const char*& data, std::size_t& size) {
+        if (_pos == _size && !NextBlock()) {
+            return false;
+        }
+        data = _data + _pos;
+        size = _size - _pos;
+        _pos = _size;
+        return true;
+    }
+
+    template <typename T>
+    bool Read(T& value) {
+        if (_size - _pos >= sizeof(T)) {
+            std::memcpy(&value, _data + _pos, sizeof(T));
+            _pos += sizeof(T);
+            return true;
+        }
+        return Read(reinterpret_cast<char*>(&value), sizeof(T)) == sizeof(T);
+    }
+};
+
+/// @brief write-behind writer: the caller fills blocks, a dedicated thread writes them out.
+/// The caller only waits when all `depth` blocks are queued for the disk.
+class AsyncWriter {
+private:
+    struct Block {
+        std::vector<char> data;
+        std::size_t size = 0;
+    };
+
+    std::ofstream _file;
+    std::vector<Block> _blocks;
+    std::size_t _head, _pending;
+    bool _closing;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _worker;
+    Block* _current;
+    IoWaitCounter* _wait;
+
+    void Work() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _cv.wait(lock, [this] { return _pending > 0 || _closing; });
+            if (_pending == 0) {
+                return;
+            }
+            Block& block = _blocks[_head];
+            lock.unlock();
+            _file.write(block.data.data(), block.size);
+            block.size = 0;
+            lock.lock();
+            _head = (_head + 1) % _blocks.size();
+            --_pending;
+            _cv.notify_all();
+        }
+    }
+
+    void Submit() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        ++_pending;
+        _cv.notify_all();
+        WaitCounted(_cv, lock, _wait, [this] { return _pending < _blocks.size(); });
+        _current = &_blocks[(_head + _pending) % _blocks.size()];
+    }
+
+public:
+    AsyncWriter(const std::string& fileName, std::size_t blockSize, std::size_t depth = 2,
+                std::ios::openmode mode = std::ios::binary | std::ios::trunc)
+        : _file(fileName, mode), _blocks(std::max<std::size_t>(depth, 2)), _head(0), _pending(0), _closing(false),
+          _wait(nullptr) {
+        for (auto& block : _blocks) {
+            block.data.resize(blockSize);
+        }
+        _current = &_blocks[0];
+        _worker = std::thread(&AsyncWriter::Work, this);
+    }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    /// @brief time spent waiting for free blocks and for the final flush is added to `counter` from now on
+    void CountWait(IoWaitCounter* counter) {
+        _wait = counter;
+    }
+
+    ~AsyncWriter() {
+        Close();
+    }
+
+    void Write(const char* src, std::size_t bytes) {
+        while (bytes > 0) {
+            std::size_t n = std::min(bytes, _current->data.size() - _current->size);
+            std::memcpy(_current->data.data() + _current->size, src, n);
+            _current->size += n;
+            src += n;
+            bytes -= n;
+            if (_current->size == _current->data.size()) {
+                Submit();
+            }
+        }
+    }
+
+    template <typename T>
+    void Write(const T& value) {
+        Write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /// @brief flushes the queued blocks and closes the file; safe to call more than once
+    void Close() {
+        if (!_worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_current->size > 0) {
+                ++_pending;
+            }
+            _closing = true;
+        }
+        _cv.notify_all();
+        auto start = std::chrono::steady_clock::now();
+        _worker.join();
+        _file.close();
+        if (_wait != nullptr) {
+            *_wait += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+};
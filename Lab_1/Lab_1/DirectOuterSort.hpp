@@ -0,0 +1,210 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "SortStats.hpp"
+#include "TempWorkspace.hpp"
+
+class DirectOuterSort {
+private:
+    long _iterations, _segments;
+    SortStats _stats;
+    ProgressReporter _progress;
+    std::string _stats_file;
+    TempWorkspace _workspace;
+    std::string _fileA, _fileB, _fileC;
+
+    static double Since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+public:
+    explicit DirectOuterSort(const std::string& tempDirectory = ".")
+        : _iterations(1), _segments(1), _workspace({ tempDirectory }),
+          _fileA(_workspace.Path("A.bin")), _fileB(_workspace.Path("B.bin")), _fileC(_workspace.Path("C.bin")) {
+        _progress.Start();
+    }
+
+    // reported from MergePairs at most once per interval
+    void SetProgressCallback(ProgressCallback callback, std::chrono::milliseconds interval = std::chrono::seconds(1)) {
+        _progress.Set(std::move(callback), interval);
+        _progress.Start();
+    }
+
+    // Sort dumps Stats() there as JSON at the end
+    void SetStatsFile(const std::string& file) {
+        _stats_file = file;
+    }
+
+    // every split + merge round is a pass; there is no separate presort, the initial runs are single records
+    const SortStats& Stats() const {
+        return _stats;
+    }
+
+    unsigned Passes() const {
+        return static_cast<unsigned>(_stats.passes.size());
+    }
+
+    // text bytes moved by the split, merge and output steps
+    std::uint64_t BytesRead() const {
+        return _stats.bytesRead;
+    }
+
+    std::uint64_t BytesWritten() const {
+        return _stats.bytesWritten;
+    }
+
+    void SplitToFiles(const std::string& inputFile) {
+        _segments = 1;
+        std::ifstream fileA(inputFile, std::ios::binary);
+
+        std::ofstream fileB(_fileB, std::ios::binary | std::ios::trunc); 
+        std::ofstream fileC(_fileC, std::ios::binary | std::ios::trunc);
+
+        std::string currentRecord;
+        bool flag = true;
+        int counter = 0;
+        std::uint64_t records = 0;
+
+        while (std::getline(fileA, currentRecord)) {
+            currentRecord += "\n";
+
+            if (counter == _iterations) {
+                counter = 0;
+                flag = !flag;
+                ++_segments;
+            }
+
+            _stats.bytesRead += currentRecord.size();
+            _stats.bytesWritten += currentRecord.size();
+            ++records;
+            if (flag) {
+                fileB.write(currentRecord.c_str(), currentRecord.size());
+            } else {
+                fileC.write(currentRecord.c_str(), currentRecord.size());
+            }
+            ++counter;
+        }
+        fileA.close();
+        fileB.close();
+        fileC.close();
+        _stats.records = records;
+        if (_stats.passes.empty()) {
+            _stats.runs = records;
+        }
+    }
+
+    std::string MergePairs() {
+        std::string fileA = _fileA;
+        std::ofstream writerA(fileA, std::ios::binary | std::ios::trunc);
+        std::ifstream readerB(_fileB, std::ios::binary);
+        std::ifstream readerC(_fileC, std::ios::binary);
+
+        std::string elementB, elementC;
+        bool hasMoreB = static_cast<bool>(std::getline(readerB, elementB));
+        bool hasMoreC = static_cast<bool>(std::getline(readerC, elementC));
+
+        int counterB = 0, counterC = 0;
+        std::uint64_t merged = 0;
+
+        while (hasMoreB || hasMoreC) {
+            bool useB = false;
+            std::string currentRecord;
+
+            if (!hasMoreB || counterB == _iterations) {
+                currentRecord = elementC;
+            } else if (!hasMoreC || counterC == _iterations) {
+                currentRecord = elementB;
+                useB = true;
+            } else {
+                ++_stats.comparisons;
+                if (std::stoi(elementB) < std::stoi(elementC)) {
+                    currentRecord = elementB;
+                    useB = true;
+                } else {
+                    currentRecord = elementC;
+                }
+            }
+
+            currentRecord += "\n";
+            writerA.write(currentRecord.c_str(), currentRecord.size());
+            _stats.bytesRead += currentRecord.size();
+            _stats.bytesWritten += currentRecord.size();
+            if ((++merged & 0xffff) == 0) {
+                _progress.Report("merge", Passes() + 1, merged, _stats.records);
+            }
+
+            if (useB) {
+                hasMoreB = static_cast<bool>(std::getline(readerB, elementB));
+                ++counterB;
+            } else {
+                hasMoreC = static_cast<bool>(std::getline(readerC, elementC));
+                ++counterC;
+            }
+
+            if (counterB == _iterations && counterC == _iterations) {
+                counterB = counterC = 0;
+            }
+        }
+        writerA.close();
+        readerB.close();
+        readerC.close();
+
+        std::ofstream fileB(_fileB, std::ios::binary | std::ios::trunc);
+        std::ofstream fileC(_fileC, std::ios::binary | std::ios::trunc);
+        fileB.close();
+        fileC.close();
+
+        _iterations *= 2;
+        return fileA;
+    }
+
+    void Sort(const std::string& inputFile, const std::string& sorted) {
+        std::string fileA = inputFile;
+        while (true) {
+            auto start = std::chrono::steady_clock::now();
+            PassStats pass;
+            pass.bytesRead = _stats.bytesRead;
+            pass.bytesWritten = _stats.bytesWritten;
+            pass.comparisons = _stats.comparisons;
+            SplitToFiles(fileA);
+            if (_segments == 1) {
+                _stats.mergeSeconds += Since(start);
+                break;
+            }
+            pass.runsIn = _segments;
+            fileA = MergePairs();
+            pass.runsOut = (_segments + 1) / 2;
+            pass.records = _stats.records;
+            pass.seconds = Since(start);
+            pass.bytesRead = _stats.bytesRead - pass.bytesRead;
+            pass.bytesWritten = _stats.bytesWritten - pass.bytesWritten;
+            pass.comparisons = _stats.comparisons - pass.comparisons;
+            _stats.mergeSeconds += pass.seconds;
+            _stats.passes.push_back(pass);
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::ifstream sortedFile(fileA, std::ios::binary);
+        std::ofstream outputFile(sorted, std::ios::trunc);
+        std::string line;
+        while (std::getline(sortedFile, line)) {
+            outputFile << line << '\n';
+            _stats.bytesRead += line.size() + 1;
+            _stats.bytesWritten += line.size() + 1;
+        }
+        sortedFile.close();
+        outputFile.close();
+        std::remove(_fileA.c_str());
+        std::remove(_fileB.c_str());
+        std::remove(_fileC.c_str());
+        _stats.outputSeconds += Since(start);
+        if (!_stats_file.empty()) {
+            std::ofstream json(_stats_file, std::ios::trunc);
+            WriteStatsJson(_stats, json);
+        }
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/// @brief tournament (loser) tree over K sorted sources.
+/// Every internal node keeps the loser of the match played there, node 0 keeps the overall winner,
+/// so replacing the winner costs exactly one leaf-to-root walk of log2(K) comparisons.
+/// Equal keys are won by the source with the smaller index, which keeps the merge stable.
+template <typename T, typename Compare = std::less<T>>
+class LoserTree {
+private:
+    std::size_t _k;
+    std::vector<std::size_t> _tree;
+    std::vector<T> _keys;
+    std::vector<bool> _alive;
+    Compare _less;
+
+    bool Beats(std::size_t a, std::size_t b) const {
+        if (!_alive[a]) return false;
+        if (!_alive[b]) return true;
+        if (_less(_keys[a], _keys[b])) return true;
+        if (_less(_keys[b], _keys[a])) return false;
+        return a < b;
+    }
+
+    std::size_t BuildNode(std::size_t node) {
+        if (node >= _k) {
+            return node - _k;
+        }
+        std::size_t left = BuildNode(2 * node);
+        std::size_t right = BuildNode(2 * node + 1);
+        if (Beats(left, right)) {
+            _tree[node] = right;
+            return left;
+        }
+        _tree[node] = left;
+        return right;
+    }
+
+    void Replay(std::size_t leaf) {
+        std::size_t winner = leaf;
+        for (std::size_t node = (leaf + _k) / 2; node > 0; node /= 2) {
+            if (Beats(_tree[node], winner)) {
+                std::swap(_tree[node], winner);
+            }
+        }
+        _tree[0] = winner;
+    }
+
+public:
+    explicit LoserTree(std::size_t k, Compare less = Compare())
+        : _k(k), _tree(k, 0), _keys(k), _alive(k, false), _less(less) {}
+
+    std::size_t Size() const { return _k; }
+
+    /// @brief sets the head of source i before Build(); sources never set are treated as exhausted
+    void Set(std::size_t i, const T& key) {
+        _keys[i] = key;
+        _alive[i] = true;
+    }
+
+    void Build() {
+        _tree[0] = BuildNode(1);
+    }
+
+    bool Empty() const { return !_alive[_tree[0]]; }
+    std::size_t Winner() const { return _tree[0]; }
+    const T& Top() const { return _keys[_tree[0]]; }
+
+    /// @brief the winning source produced its next element
+    void Replace(const T& key) {
+        std::size_t w = _tree[0];
+        _keys[w] = key;
+        Replay(w);
+    }
+
+    /// @brief the winning source is exhausted
+    void Remove() {
+        std::size_t w = _tree[0];
+        _alive[w] = false;
+        Replay(w);
+    }
+
+    void Reset() {
+        std::fill(_alive.begin(), _alive.end(), false);
+    }
+};
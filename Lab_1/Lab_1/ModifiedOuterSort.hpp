@@ -0,0 +1,845 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncIO.hpp"
+#include "LoserTree.hpp"
+#include "RadixSort.hpp"
+#include "RunCodec.hpp"
+#include "RunIndex.hpp"
+#include "SortStats.hpp"
+#include "TempWorkspace.hpp"
+#include "TextIO.hpp"
+
+#define CHUNK_SIZE 4'000'000
+#define MERGE_BUFFER_SIZE (1 << 20)
+#define IO_BLOCK_SIZE (4 << 20)
+#define MAX_FAN_IN 64
+#define MIN_MERGE_BUFFER (256 << 10)
+
+enum class RunGeneration {
+    Chunks,
+    ReplacementSelection
+};
+
+enum class SortKernel {
+    Std,
+    Radix
+};
+
+enum class MergeStrategy {
+    Balanced,
+    Polyphase
+};
+
+inline void SortChunk(SortKernel kernel, int* data, std::size_t n, int* buffer) {
+    if (kernel == SortKernel::Radix) {
+        RadixSort(data, n, buffer);
+    } else {
+        std::sort(data, data + n);
+    }
+}
+
+struct SortPlan {
+    std::uint64_t records;
+    long runLength;
+    std::uint64_t runs;
+    long fanIn;
+    unsigned passes;
+    std::size_t mergeBuffer;
+    std::size_t ioBlock;
+    std::uint64_t bytesMoved;
+};
+
+// pulls the merged records of several runs one at a time
+class RunMerger {
+private:
+    std::vector<std::unique_ptr<RunDecoder>> _readers;
+    LoserTree<int> _tree;
+
+public:
+    explicit RunMerger(std::vector<std::unique_ptr<RunDecoder>> readers)
+        : _readers(std::move(readers)), _tree(_readers.size()) {
+        int element;
+        for (std::size_t i = 0; i < _readers.size(); ++i) {
+            if (_readers[i]->Read(element)) {
+                _tree.Set(i, element);
+            }
+        }
+        if (!_readers.empty()) {
+            _tree.Build();
+        }
+    }
+
+    bool Next(int& value) {
+        if (_readers.empty() || _tree.Empty()) {
+            return false;
+        }
+        value = _tree.Top();
+        int element;
+        if (_readers[_tree.Winner()]->Read(element)) {
+            _tree.Replace(element);
+        } else {
+            _tree.Remove();
+        }
+        return true;
+    }
+};
+
+class ModifiedOuterSort {
+private:
+    long chunk_length;
+    std::size_t _memory_budget;
+    std::size_t _merge_buffer;
+    std::size_t _io_block;
+    long _max_fan_in;
+    RunGeneration _run_generation;
+    SortKernel _kernel;
+    unsigned _threads;
+    MergeStrategy _strategy;
+    unsigned _tapes;
+    RunCodec _codec;
+    RunCodec _run_codec;
+    std::vector<RunInfo> _runs;
+    std::vector<std::string> _temp_dirs;
+    std::unique_ptr<TempWorkspace> _workspace;
+    SortStats _stats;
+    IoWaitCounter _io_wait;
+    ProgressReporter _progress;
+    std::string _stats_file;
+
+    struct Tape {
+        std::string file;
+        RunCodec codec;
+        std::deque<RunInfo> runs;
+    };
+
+    static std::uint64_t TotalBytes(const std::vector<RunInfo>& runs) {
+        std::uint64_t bytes = 0;
+        for (const RunInfo& run : runs) {
+            bytes += run.bytes;
+        }
+        return bytes;
+    }
+
+    static double Since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double IoWaitSeconds() const {
+        return _io_wait / 1e9;
+    }
+
+    // folds a finished merge pass, timed from `start` with `waited` ns of I/O wait before it, into the stats
+    void EndPass(PassStats& pass, std::chrono::steady_clock::time_point start, std::uint64_t waited) {
+        pass.seconds = Since(start);
+        pass.ioWaitSeconds = (_io_wait - waited) / 1e9;
+        _stats.mergeSeconds += pass.seconds;
+        _stats.ioWaitSeconds = IoWaitSeconds();
+        _stats.bytesRead += pass.bytesRead;
+        _stats.bytesWritten += pass.bytesWritten;
+        _stats.comparisons += pass.comparisons;
+        _stats.passes.push_back(pass);
+    }
+
+    static std::string TapeName(unsigned i) {
+        return "P" + std::to_string(i) + ".bin";
+    }
+
+    // one writer per temp volume: run i of the file goes to volume i % volumes, so consecutive runs,
+    // which are merged together later, are read from different devices
+    class StripedWriter {
+    private:
+        std::vector<std::unique_ptr<AsyncWriter>> _writers;
+        std::vector<std::unique_ptr<RunEncoder>> _encoders;
+        std::vector<std::uint64_t> _offsets;
+        std::size_t _current;
+
+    public:
+        StripedWriter(const std::vector<std::string>& files, std::size_t blockSize, std::size_t depth, RunCodec codec,
+                      IoWaitCounter* wait)
+            : _offsets(files.size(), 0), _current(0) {
+            for (const std::string& file : files) {
+                _writers.push_back(std::make_unique<AsyncWriter>(file, blockSize, depth));
+                _writers.back()->CountWait(wait);
+                _encoders.push_back(std::make_unique<RunEncoder>(*_writers.back(), codec));
+            }
+        }
+
+        RunEncoder& Current() {
+            return *_encoders[_current];
+        }
+
+        RunInfo EndRun(std::uint64_t length) {
+            std::uint64_t bytes = _encoders[_current]->EndRun();
+            RunInfo run{ _offsets[_current], length, bytes, _current };
+            _offsets[_current] += bytes;
+            _current = (_current + 1) % _encoders.size();
+            return run;
+        }
+
+        void Close() {
+            for (auto& writer : _writers) {
+                writer->Close();
+            }
+        }
+    };
+
+    std::unique_ptr<StripedWriter> _spill;
+    std::string _spill_file;
+
+    TempWorkspace& Workspace() {
+        if (!_workspace) {
+            _workspace = std::make_unique<TempWorkspace>(_temp_dirs);
+        }
+        return *_workspace;
+    }
+
+    // the part of a run file on volume v > 0 has the same name in the workspace directory of that volume
+    std::string StripeFile(const std::string& file, std::uint64_t volume) {
+        if (volume == 0) {
+            return file;
+        }
+        return Workspace().Path(std::filesystem::path(file).filename().string(), volume);
+    }
+
+    StripedWriter OpenStripes(const std::string& file, std::size_t blockSize, std::size_t depth) {
+        std::vector<std::string> files;
+        for (std::size_t v = 0; v < Workspace().Volumes(); ++v) {
+            files.push_back(StripeFile(file, v));
+        }
+        return StripedWriter(files, blockSize, depth, _codec, &_io_wait);
+    }
+
+    void FixedLengthRuns(const std::string& inputFile) {
+        std::ifstream file(inputFile, std::ios::binary | std::ios::ate);
+        long long total = static_cast<long long>(file.tellg()) / sizeof(int);
+        _runs.clear();
+        _run_codec = RunCodec::None;
+        for (long long offset = 0; offset < total; offset += chunk_length) {
+            long long length = std::min<long long>(chunk_length, total - offset);
+            _runs.push_back({ sizeof(int) * offset, static_cast<std::uint64_t>(length), sizeof(int) * length, 0 });
+        }
+    }
+
+    // up to _threads chunks are sorted concurrently and written in input order; the read-ahead and
+    // write-behind queues hold a whole chunk each, so loading and writing overlap with the sorts
+    void ChunkRuns(AsyncReader& fileA, StripedWriter& fileB) {
+        std::vector<std::vector<int>> chunks(_threads, std::vector<int>(chunk_length));
+        std::vector<std::vector<int>> buffers(_kernel == SortKernel::Radix ? _threads : 0, std::vector<int>(chunk_length));
+        std::vector<std::size_t> sizes(_threads);
+        std::vector<std::future<void>> sorted(_threads);
+        std::uint64_t done = 0;
+        auto flush = [&](std::size_t slot) {
+            sorted[slot].get();
+            fileB.Current().Write(chunks[slot].data(), sizes[slot]);
+            _runs.push_back(fileB.EndRun(sizes[slot]));
+            done += sizes[slot];
+            _progress.Report("presort", 0, done, _stats.records);
+        };
+
+        std::size_t slot = 0;
+        while (1) {
+            if (sorted[slot].valid()) {
+                flush(slot);
+            }
+            sizes[slot] = fileA.Read((char*)chunks[slot].data(), sizeof(int) * chunk_length) / sizeof(int);
+            if (sizes[slot] == 0) {
+                break;
+            }
+            int* buffer = buffers.empty() ? nullptr : buffers[slot].data();
+            sorted[slot] = std::async(std::launch::async, [this, data = chunks[slot].data(), c = sizes[slot], buffer] {
+                SortChunk(_kernel, data, c, buffer);
+            });
+            slot = (slot + 1) % _threads;
+        }
+        for (std::size_t i = 1; i < _threads; ++i) {
+            std::size_t oldest = (slot + i) % _threads;
+            if (sorted[oldest].valid()) {
+                flush(oldest);
+            }
+        }
+    }
+
+    std::size_t ChunkDepth() const {
+        return sizeof(int) * chunk_length / _io_block + 2;
+    }
+
+    // snowplow: a min-heap of chunk_length records ordered by (run, value); a record smaller than
+    // the one just written can't extend the current run and is tagged for the next one
+    void ReplacementSelectionRuns(AsyncReader& fileA, StripedWriter& fileB) {
+        auto pack = [](std::uint64_t run, int value) {
+            return (run << 32) | (static_cast<std::uint32_t>(value) ^ 0x80000000u);
+        };
+        auto unpack = [](std::uint64_t entry) {
+            return static_cast<int>(static_cast<std::uint32_t>(entry) ^ 0x80000000u);
+        };
+
+        std::vector<std::uint64_t> heap;
+        heap.reserve(chunk_length);
+        int value;
+        while (heap.size() < static_cast<std::size_t>(chunk_length) && fileA.Read(value)) {
+            heap.push_back(pack(0, value));
+        }
+        std::make_heap(heap.begin(), heap.end(), std::greater<std::uint64_t>());
+
+        std::uint64_t currentRun = 0;
+        long long currentLength = 0;
+        std::uint64_t done = 0;
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<std::uint64_t>());
+            std::uint64_t top = heap.back();
+            std::uint64_t run = top >> 32;
+            int last = unpack(top);
+            if (run != currentRun) {
+                _runs.push_back(fileB.EndRun(currentLength));
+                currentLength = 0;
+                currentRun = run;
+            }
+            fileB.Current().Write(last);
+            ++currentLength;
+            if ((++done & 0xffff) == 0) {
+                _progress.Report("presort", 0, done, _stats.records);
+            }
+            if (fileA.Read(value)) {
+                heap.back() = pack(value < last ? run + 1 : run, value);
+                std::push_heap(heap.begin(), heap.end(), std::greater<std::uint64_t>());
+            } else {
+                heap.pop_back();
+            }
+        }
+        if (currentLength > 0) {
+            _runs.push_back(fileB.EndRun(currentLength));
+        }
+    }
+
+public:
+    ModifiedOuterSort() : ModifiedOuterSort(CHUNK_SIZE) {}
+    ModifiedOuterSort(int cl) : ModifiedOuterSort(cl, sizeof(int) * cl) {}
+    ModifiedOuterSort(int cl, std::size_t memoryBudget)
+        : chunk_length(cl), _memory_budget(memoryBudget), _merge_buffer(MERGE_BUFFER_SIZE), _io_block(IO_BLOCK_SIZE),
+          _max_fan_in(MAX_FAN_IN),
+          _run_generation(RunGeneration::Chunks), _kernel(SortKernel::Std), _threads(std::max(1u, std::thread::hardware_concurrency())),
+          _strategy(MergeStrategy::Balanced), _tapes(3), _codec(RunCodec::None), _run_codec(RunCodec::None),
+          _io_wait(0) {
+        _progress.Start();
+    }
+
+    // Temp files live in a private extsort-<random> directory under the first directory, so several sorts
+    // can run side by side. Runs are striped over all the directories, one per device ideally.
+    void SetTempDirectories(const std::vector<std::string>& directories) {
+        _temp_dirs = directories;
+        _workspace.reset();
+    }
+
+    // path of a temp file in the job's workspace; it is removed together with the workspace
+    std::string TempFile(const std::string& name) {
+        return Workspace().Path(name);
+    }
+
+    void SetMemoryBudget(std::size_t bytes) {
+        _memory_budget = bytes;
+    }
+
+    void SetRunGeneration(RunGeneration mode) {
+        _run_generation = mode;
+    }
+
+    // the radix kernel needs a scratch chunk per thread
+    void SetSortKernel(SortKernel kernel) {
+        _kernel = kernel;
+    }
+
+    SortKernel Kernel() const {
+        return _kernel;
+    }
+
+    // chunk presort only; every thread holds its own chunk, so memory grows by chunk_length ints per thread
+    void SetThreads(unsigned threads) {
+        _threads = std::max(1u, threads);
+    }
+
+    // polyphase keeps exactly `tapes` files open while merging: tapes - 1 inputs and one output
+    void SetMergeStrategy(MergeStrategy strategy, unsigned tapes = 3) {
+        _strategy = strategy;
+        _tapes = std::max(3u, tapes);
+    }
+
+    // format of the runs written by Preparation and the merge passes
+    void SetRunCodec(RunCodec codec) {
+        _codec = codec;
+    }
+
+    // every input run and the output get two merge buffers out of the budget:
+    // one being consumed or filled, one in flight on the I/O thread
+    long MergeFanIn() const {
+        long k = static_cast<long>(_memory_budget / (2 * _merge_buffer)) - 1;
+        return std::max(2L, std::min(k, _max_fan_in));
+    }
+
+    long Runs() const {
+        return static_cast<long>(_runs.size());
+    }
+
+    // Called from the sorting thread with the phase's progress, at most once per interval; the
+    // elapsed time counts from here
+    void SetProgressCallback(ProgressCallback callback, std::chrono::milliseconds interval = std::chrono::seconds(1)) {
+        _progress.Set(std::move(callback), interval);
+        _progress.Start();
+    }
+
+    // PostWrite dumps Stats() there as JSON once the output is written
+    void SetStatsFile(const std::string& file) {
+        _stats_file = file;
+    }
+
+    // bytes are counted as the sorter sees them: compressed run sizes when compressing
+    const SortStats& Stats() const {
+        return _stats;
+    }
+
+    // merge passes done so far; every polyphase phase counts as one
+    unsigned MergePasses() const {
+        return static_cast<unsigned>(_stats.passes.size());
+    }
+
+    std::uint64_t BytesRead() const {
+        return _stats.bytesRead;
+    }
+
+    std::uint64_t BytesWritten() const {
+        return _stats.bytesWritten;
+    }
+
+    // record count of a text file, extrapolated from the line lengths of its first MiB
+    static std::uint64_t EstimateRecords(const std::string& textFile) {
+        std::ifstream file(textFile, std::ios::binary | std::ios::ate);
+        std::uint64_t size = file ? static_cast<std::uint64_t>(file.tellg()) : 0;
+        if (size == 0) {
+            return 0;
+        }
+        std::vector<char> sample(static_cast<std::size_t>(std::min<std::uint64_t>(size, 1 << 20)));
+        file.seekg(0);
+        file.read(sample.data(), sample.size());
+        std::uint64_t lines = std::max<std::uint64_t>(1, std::count(sample.begin(), sample.end(), '\n'));
+        return size * lines / sample.size();
+    }
+
+    // Splits a RAM budget between the phases for the given text input, aiming at the fewest merge passes:
+    // the presort gets the largest chunk its threads and I/O queues fit in, the merge the smallest fan-in
+    // that still reaches the minimal pass count, so every stream gets the largest buffer possible.
+    SortPlan AutoTune(std::size_t budget, const std::string& textFile) {
+        SortPlan plan{};
+        plan.records = EstimateRecords(textFile);
+        _memory_budget = budget;
+        _io_block = std::min<std::size_t>(std::max<std::size_t>(budget / 16, MIN_MERGE_BUFFER), 64 << 20);
+
+        std::size_t presort = budget > 4 * _io_block ? budget - 4 * _io_block : budget / 2;
+        std::uint64_t length;
+        if (_run_generation == RunGeneration::ReplacementSelection) {
+            length = presort / sizeof(std::uint64_t);
+        } else {
+            unsigned perThread = _kernel == SortKernel::Radix ? 2 : 1;
+            length = presort / (sizeof(int) * (_threads * perThread + 2));
+        }
+        // the record count is an estimate, leave some slack so the tail doesn't spill into a tiny extra run
+        length = std::min<std::uint64_t>(length, plan.records + plan.records / 16 + 1);
+        chunk_length = static_cast<long>(std::min<std::uint64_t>(std::max<std::uint64_t>(length, 1024), 1 << 30));
+        plan.runLength = chunk_length;
+
+        std::uint64_t produced = _run_generation == RunGeneration::ReplacementSelection ? 2 * chunk_length : chunk_length;
+        plan.runs = (plan.records + produced - 1) / produced;
+
+        long widest = static_cast<long>(budget / (2 * MIN_MERGE_BUFFER)) - 1;
+        widest = std::max(2L, std::min(widest, static_cast<long>(MAX_FAN_IN)));
+        plan.passes = 0;
+        for (std::uint64_t reach = 1; reach < plan.runs; reach *= widest) {
+            ++plan.passes;
+        }
+        plan.fanIn = 2;
+        if (plan.passes > 0) {
+            auto reaches = [&](long k) {
+                std::uint64_t reach = 1;
+                for (unsigned p = 0; p < plan.passes && reach < plan.runs; ++p) {
+                    reach *= k;
+                }
+                return reach >= plan.runs;
+            };
+            while (!reaches(plan.fanIn)) {
+                ++plan.fanIn;
+            }
+        }
+        _max_fan_in = plan.fanIn;
+        _merge_buffer = std::min<std::size_t>(budget / (2 * (plan.fanIn + 1)), 64 << 20);
+        plan.mergeBuffer = _merge_buffer;
+        plan.ioBlock = _io_block;
+
+        // text in and out, the binary conversion, the presort read + write, every pass read + write
+        std::uint64_t textBytes = 0;
+        std::ifstream text(textFile, std::ios::binary | std::ios::ate);
+        if (text) {
+            textBytes = static_cast<std::uint64_t>(text.tellg());
+        }
+        plan.bytesMoved = 2 * textBytes + sizeof(int) * plan.records * (4 + 2 * plan.passes);
+        return plan;
+    }
+
+    static void PrintPlan(const SortPlan& plan, std::ostream& out) {
+        out << "Plan: ~" << plan.records << " records, run length " << plan.runLength
+            << ", ~" << plan.runs << " runs, fan-in " << plan.fanIn << ", " << plan.passes << " merge pass(es)\n"
+            << "      merge buffer " << plan.mergeBuffer / 1024 << " KiB, I/O block " << plan.ioBlock / 1024
+            << " KiB, ~" << plan.bytesMoved / (1 << 20) << " MiB moved (uncompressed)\n";
+    }
+
+    void ConvertStringToInt(const std::string& inputFile, const std::string& outputFile) {
+        auto start = std::chrono::steady_clock::now();
+        AsyncReader fileA(inputFile, _io_block);
+        AsyncWriter fileB(outputFile, _io_block);
+        fileA.CountWait(&_io_wait);
+        fileB.CountWait(&_io_wait);
+        std::vector<int> chunk;
+        chunk.reserve(_merge_buffer / sizeof(int));
+        std::uint64_t records = 0;
+        ParseIntLines(fileA, [&](int value) {
+            chunk.push_back(value);
+            if (chunk.size() == chunk.capacity()) {
+                fileB.Write((char*)chunk.data(), sizeof(int) * chunk.size());
+                records += chunk.size();
+                chunk.clear();
+                _progress.Report("convert", 0, records, 0);
+            }
+        });
+        if (chunk.size() > 0) {
+            fileB.Write((char*)chunk.data(), sizeof(int) * chunk.size());
+            records += chunk.size();
+        }
+        fileB.Close();
+        _stats.records = records;
+        _stats.bytesRead += std::filesystem::file_size(inputFile);
+        _stats.bytesWritten += sizeof(int) * records;
+        _stats.convertSeconds += Since(start);
+        _stats.ioWaitSeconds = IoWaitSeconds();
+    }
+
+    void Preparation(const std::string& inputFile, const std::string& outputFile) {
+        auto start = std::chrono::steady_clock::now();
+        _stats.records = std::filesystem::file_size(inputFile) / sizeof(int);
+        std::size_t depth = _run_generation == RunGeneration::Chunks ? ChunkDepth() : 2;
+        AsyncReader fileA(inputFile, _io_block, depth);
+        fileA.CountWait(&_io_wait);
+        StripedWriter fileB = OpenStripes(outputFile, _io_block, depth);
+        _runs.clear();
+        if (_run_generation == RunGeneration::ReplacementSelection) {
+            ReplacementSelectionRuns(fileA, fileB);
+        } else {
+            ChunkRuns(fileA, fileB);
+        }
+        fileB.Close();
+        _run_codec = _codec;
+        SaveRunIndex(outputFile, _runs);
+        _stats.runs = _runs.size();
+        _stats.bytesRead += sizeof(int) * _stats.records;
+        _stats.bytesWritten += TotalBytes(_runs);
+        _stats.presortSeconds += Since(start);
+        _stats.ioWaitSeconds = IoWaitSeconds();
+    }
+
+    // sorts one buffer in memory with the configured kernel
+    void SortRun(int* data, std::size_t n) {
+        std::vector<int> buffer(_kernel == SortKernel::Radix ? n : 0);
+        SortChunk(_kernel, data, n, buffer.data());
+    }
+
+    // Runs fed from memory instead of Preparation (see StreamSorter): BeginRuns creates `file`, every
+    // SpillRun sorts a buffer and appends it as the next run, EndRuns closes the file and saves its index.
+    void BeginRuns(const std::string& file) {
+        _runs.clear();
+        _spill_file = file;
+        _spill = std::make_unique<StripedWriter>(OpenStripes(file, _io_block, 2));
+    }
+
+    void SpillRun(int* data, std::size_t n) {
+        auto start = std::chrono::steady_clock::now();
+        SortRun(data, n);
+        _spill->Current().Write(data, n);
+        _runs.push_back(_spill->EndRun(n));
+        _stats.records += n;
+        _stats.bytesWritten += _runs.back().bytes;
+        _stats.presortSeconds += Since(start);
+        _progress.Report("presort", 0, _stats.records, 0);
+    }
+
+    void EndRuns() {
+        _spill->Close();
+        _spill.reset();
+        _run_codec = _codec;
+        SaveRunIndex(_spill_file, _runs);
+        _stats.runs = _runs.size();
+        _stats.ioWaitSeconds = IoWaitSeconds();
+    }
+
+    // merge passes until the runs left fit into one final merge; returns the file holding them
+    std::string ReduceRuns(const std::string& inputFile) {
+        std::string fileA = inputFile;
+        while (_runs.size() > static_cast<std::size_t>(MergeFanIn())) {
+            fileA = MergeRuns(fileA);
+        }
+        return fileA;
+    }
+
+    // the final merge of all runs of `file`, as a stream
+    std::unique_ptr<RunMerger> OpenMerge(const std::string& file) {
+        std::vector<std::unique_ptr<RunDecoder>> readers;
+        for (const RunInfo& run : _runs) {
+            readers.push_back(OpenRun(file, run, _run_codec));
+        }
+        return std::make_unique<RunMerger>(std::move(readers));
+    }
+
+    std::unique_ptr<RunDecoder> OpenRun(const std::string& file, const RunInfo& run, RunCodec codec) {
+        return OpenRun(file, run, codec, _merge_buffer);
+    }
+
+    std::unique_ptr<RunDecoder> OpenRun(const std::string& file, const RunInfo& run, RunCodec codec,
+                                        std::size_t blockSize) {
+        auto reader = std::make_unique<AsyncReader>(StripeFile(file, run.volume), blockSize, 2, run.offset, run.bytes);
+        reader->CountWait(&_io_wait);
+        return std::make_unique<RunDecoder>(std::move(reader), codec);
+    }
+
+    void MergeGroup(std::vector<std::unique_ptr<RunDecoder>>& readers, RunEncoder& writer, PassStats& pass) {
+        if (readers.empty()) {
+            return;
+        }
+        LoserTree<int, CountingLess<int>> tree(readers.size(), CountingLess<int>{ &pass.comparisons });
+        int element;
+        for (std::size_t i = 0; i < readers.size(); ++i) {
+            if (readers[i]->Read(element)) {
+                tree.Set(i, element);
+            }
+        }
+        tree.Build();
+        while (!tree.Empty()) {
+            std::size_t w = tree.Winner();
+            writer.Write(tree.Top());
+            if ((++pass.records & 0xffff) == 0) {
+                _progress.Report("merge", MergePasses() + 1, pass.records, _stats.records);
+            }
+            if (readers[w]->Read(element)) {
+                tree.Replace(element);
+            } else {
+                tree.Remove();
+            }
+        }
+    }
+
+    // merges groups of MergeFanIn() neighbouring runs, reading each one straight from the run file
+    // by its offset in the index; the merged runs go to the other of A.bin/C.bin in the workspace
+    std::string MergeRuns(const std::string& inputFile) {
+        std::string outputFile = inputFile == TempFile("C.bin") ? TempFile("A.bin") : TempFile("C.bin");
+        StripedWriter writer = OpenStripes(outputFile, _merge_buffer, 2);
+
+        const std::size_t fanIn = MergeFanIn();
+        std::vector<RunInfo> merged;
+        PassStats pass;
+        pass.runsIn = _runs.size();
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t waited = _io_wait;
+
+        for (std::size_t first = 0; first < _runs.size(); first += fanIn) {
+            std::size_t k = std::min(fanIn, _runs.size() - first);
+            std::vector<std::unique_ptr<RunDecoder>> readers;
+            std::uint64_t length = 0;
+            for (std::size_t i = 0; i < k; ++i) {
+                readers.push_back(OpenRun(inputFile, _runs[first + i], _run_codec));
+                length += _runs[first + i].length;
+            }
+            MergeGroup(readers, writer.Current(), pass);
+            merged.push_back(writer.EndRun(length));
+        }
+        writer.Close();
+        _run_codec = _codec;
+        pass.runsOut = merged.size();
+        pass.bytesRead = TotalBytes(_runs);
+        pass.bytesWritten = TotalBytes(merged);
+        EndPass(pass, start, waited);
+
+        _runs.swap(merged);
+        SaveRunIndex(outputFile, _runs);
+        return outputFile;
+    }
+
+    // Runs are dealt to tapes - 1 logical tapes in a generalized Fibonacci distribution, padded with
+    // empty dummy runs. The initial tapes point into the run file itself, so nothing is copied to
+    // distribute them. Every phase merges one run from each input tape onto the output tape until an
+    // input tape runs dry; that tape becomes the next output, and no pass redistributes the runs.
+    // With several temp volumes the tapes are spread over them round-robin.
+    std::string PolyphaseMerge(const std::string& inputFile) {
+        const unsigned inputs = _tapes - 1;
+        std::vector<std::uint64_t> target(inputs, 0);
+        target[0] = 1;
+        while (std::accumulate(target.begin(), target.end(), std::uint64_t(0)) < _runs.size()) {
+            std::uint64_t first = target[0];
+            for (unsigned i = 0; i < inputs; ++i) {
+                target[i] = first + (i + 1 < inputs ? target[i + 1] : 0);
+            }
+        }
+
+        std::vector<std::uint64_t> dummies(inputs, 0);
+        std::uint64_t missing = std::accumulate(target.begin(), target.end(), std::uint64_t(0)) - _runs.size();
+        for (unsigned i = 0; missing > 0; i = (i + 1) % inputs) {
+            if (dummies[i] < target[i]) {
+                ++dummies[i];
+                --missing;
+            }
+        }
+
+        std::vector<Tape> tapes(_tapes);
+        std::size_t next = 0;
+        for (unsigned i = 0; i < inputs; ++i) {
+            tapes[i].file = inputFile;
+            tapes[i].codec = _run_codec;
+            tapes[i].runs.assign(dummies[i], RunInfo{ 0, 0, 0, 0 });
+            for (std::uint64_t r = dummies[i]; r < target[i]; ++r) {
+                tapes[i].runs.push_back(_runs[next++]);
+            }
+        }
+
+        unsigned output = inputs;
+        while (true) {
+            std::size_t phaseMerges = SIZE_MAX;
+            std::size_t total = 0;
+            for (unsigned i = 0; i < _tapes; ++i) {
+                total += tapes[i].runs.size();
+                if (i != output) {
+                    phaseMerges = std::min(phaseMerges, tapes[i].runs.size());
+                }
+            }
+            if (total <= 1) {
+                break;
+            }
+
+            tapes[output].file = Workspace().Path(TapeName(output), output);
+            tapes[output].codec = _codec;
+            PassStats pass;
+            auto start = std::chrono::steady_clock::now();
+            std::uint64_t waited = _io_wait;
+            AsyncWriter writer(tapes[output].file, _merge_buffer);
+            writer.CountWait(&_io_wait);
+            RunEncoder encoder(writer, _codec);
+            std::uint64_t offset = 0;
+            for (std::size_t m = 0; m < phaseMerges; ++m) {
+                std::vector<std::unique_ptr<RunDecoder>> readers;
+                std::uint64_t length = 0;
+                for (unsigned i = 0; i < _tapes; ++i) {
+                    if (i == output) {
+                        continue;
+                    }
+                    RunInfo run = tapes[i].runs.front();
+                    tapes[i].runs.pop_front();
+                    if (run.length > 0) {
+                        readers.push_back(OpenRun(tapes[i].file, run, tapes[i].codec));
+                        length += run.length;
+                        pass.bytesRead += run.bytes;
+                        ++pass.runsIn;
+                    }
+                }
+                MergeGroup(readers, encoder, pass);
+                std::uint64_t bytes = encoder.EndRun();
+                tapes[output].runs.push_back({ offset, length, bytes, 0 });
+                offset += bytes;
+            }
+            writer.Close();
+            pass.runsOut = phaseMerges;
+            pass.bytesWritten = offset;
+            EndPass(pass, start, waited);
+
+            for (unsigned i = 0; i < _tapes; ++i) {
+                if (i != output && tapes[i].runs.empty()) {
+                    output = i;
+                    break;
+                }
+            }
+        }
+
+        for (Tape& tape : tapes) {
+            if (!tape.runs.empty()) {
+                _runs.assign(tape.runs.begin(), tape.runs.end());
+                _run_codec = tape.codec;
+                SaveRunIndex(tape.file, _runs);
+                return tape.file;
+            }
+        }
+        return inputFile;
+    }
+
+    void PostWrite(const std::string& inputFile, const std::string& outputFile) {
+        if (_runs.empty() && !LoadRunIndex(inputFile, _runs)) {
+            FixedLengthRuns(inputFile);
+        }
+        auto start = std::chrono::steady_clock::now();
+        AsyncWriter s2(outputFile, _io_block);
+        s2.CountWait(&_io_wait);
+        std::uint64_t done = 0;
+        std::vector<int> v(_merge_buffer / sizeof(int));
+        std::vector<char> text(MAX_INT_TEXT * v.size());
+        for (const RunInfo& run : _runs) {
+            auto s1 = OpenRun(inputFile, run, _run_codec, _io_block);
+            while (1) {
+                int i = s1->Read(v.data(), v.size());
+                if (i == 0) {
+                    break;
+                }
+                char* end = text.data();
+                for (int j = 0; j < i; ++j) {
+                    end = FormatIntLine(end, v[j]);
+                }
+                s2.Write(text.data(), end - text.data());
+                _stats.bytesWritten += end - text.data();
+                done += i;
+                _progress.Report("output", 0, done, _stats.records);
+            }
+        }
+        s2.Close();
+        _stats.bytesRead += TotalBytes(_runs);
+        _stats.outputSeconds += Since(start);
+        _stats.ioWaitSeconds = IoWaitSeconds();
+        if (!_stats_file.empty()) {
+            std::ofstream json(_stats_file, std::ios::trunc);
+            WriteStatsJson(_stats, json);
+        }
+        _workspace.reset();
+    }
+
+    // returns the name of the sorted file
+    std::string Sort(const std::string& inputFile) {
+        std::string fileA = inputFile;
+        if (_runs.empty()) {
+            if (LoadRunIndex(fileA, _runs)) {
+                _run_codec = _codec;
+            } else {
+                FixedLengthRuns(fileA);
+            }
+        }
+        if (_strategy == MergeStrategy::Polyphase && _runs.size() > 1) {
+            return PolyphaseMerge(fileA);
+        }
+        while (_runs.size() > 1) {
+            fileA = MergeRuns(fileA);
+        }
+        return fileA;
+    }
+};
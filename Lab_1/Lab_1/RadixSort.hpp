@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/// @brief LSD radix sort of 32-bit signed ints with DigitBits-wide digits (8 -> 4 passes, 11 -> 3 passes).
+/// The sign bit is flipped so negative values order before positive ones as unsigned keys.
+/// All histograms are built in one read pass up front, and passes whose digit is the same for every
+/// element are skipped. `buffer` must hold n ints; the result is always left in `data`.
+template <unsigned DigitBits = 11>
+void RadixSort(int* data, std::size_t n, int* buffer) {
+    constexpr unsigned passes = (32 + DigitBits - 1) / DigitBits;
+    constexpr std::size_t buckets = std::size_t(1) << DigitBits;
+    constexpr std::uint32_t mask = buckets - 1;
+
+    if (n < 2) {
+        return;
+    }
+
+    std::vector<std::size_t> counts(passes * buckets, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint32_t key = static_cast<std::uint32_t>(data[i]) ^ 0x80000000u;
+        for (unsigned p = 0; p < passes; ++p) {
+            ++counts[p * buckets + ((key >> (p * DigitBits)) & mask)];
+        }
+    }
+
+    int* from = data;
+    int* to = buffer;
+    for (unsigned p = 0; p < passes; ++p) {
+        std::size_t* count = &counts[p * buckets];
+        std::uint32_t first = ((static_cast<std::uint32_t>(from[0]) ^ 0x80000000u) >> (p * DigitBits)) & mask;
+        if (count[first] == n) {
+            continue;
+        }
+        std::size_t sum = 0;
+        for (std::size_t b = 0; b < buckets; ++b) {
+            std::size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint32_t key = static_cast<std::uint32_t>(from[i]) ^ 0x80000000u;
+            to[count[(key >> (p * DigitBits)) & mask]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::memcpy(data, from, sizeof(int) * n);
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "AsyncIO.hpp"
+
+/// @brief on-disk format of sorted runs
+enum class RunCodec {
+    None,       // raw ints
+    DeltaVarint // blocks of RUN_CODEC_BLOCK ints: first value raw, then LEB128 varints of the deltas
+};
+
+/// @brief values per codec block; a block is decoded in one tight loop from one contiguous copy
+constexpr std::size_t RUN_CODEC_BLOCK = 4096;
+
+/// @brief writes the ints of consecutive runs in the chosen codec. Blocks never cross runs, so every run
+/// can be decoded on its own starting from its offset.
+/// Block layout: uint32 payload bytes, uint32 count, int32 first value, count - 1 varint deltas.
+/// Deltas are taken modulo 2^32, so a run that is not sorted still round-trips, it just packs worse.
+class RunEncoder {
+private:
+    AsyncWriter& _out;
+    RunCodec _codec;
+    std::vector<int> _values;
+    std::vector<unsigned char> _bytes;
+    std::uint64_t _run_bytes;
+
+    void Flush() {
+        if (_values.empty()) {
+            return;
+        }
+        unsigned char* p = _bytes.data() + 2 * sizeof(std::uint32_t);
+        std::memcpy(p, &_values[0], sizeof(int));
+        p += sizeof(int);
+        for (std::size_t i = 1; i < _values.size(); ++i) {
+            std::uint32_t delta = static_cast<std::uint32_t>(_values[i]) - static_cast<std::uint32_t>(_values[i - 1]);
+            while (delta >= 0x80) {
+                *p++ = static_cast<unsigned char>(delta | 0x80);
+                delta >>= 7;
+            }
+            *p++ = static_cast<unsigned char>(delta);
+        }
+        std::uint32_t header[2] = {
+            static_cast<std::uint32_t>(p - _bytes.data() - sizeof(header)),
+            static_cast<std::uint32_t>(_values.size())
+        };
+        std::memcpy(_bytes.data(), header, sizeof(header));
+        _out.Write((const char*)_bytes.data(), p - _bytes.data());
+        _run_bytes += p - _bytes.data();
+        _values.clear();
+    }
+
+public:
+    RunEncoder(AsyncWriter& out, RunCodec codec) : _out(out), _codec(codec), _run_bytes(0) {
+        if (_codec == RunCodec::DeltaVarint) {
+            _values.reserve(RUN_CODEC_BLOCK);
+            _bytes.resize(2 * sizeof(std::uint32_t) + sizeof(int) + 5 * RUN_CODEC_BLOCK);
+        }
+    }
+
+    void Write(int value) {
+        if (_codec == RunCodec::None) {
+            _out.Write(value);
+            _run_bytes += sizeof(int);
+            return;
+        }
+        _values.push_back(value);
+        if (_values.size() == RUN_CODEC_BLOCK) {
+            Flush();
+        }
+    }
+
+    void Write(const int* data, std::size_t n) {
+        if (_codec == RunCodec::None) {
+            _out.Write((const char*)data, sizeof(int) * n);
+            _run_bytes += sizeof(int) * n;
+            return;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            Write(data[i]);
+        }
+    }
+
+    /// @brief closes the current run; returns its size in bytes
+    std::uint64_t EndRun() {
+        Flush();
+        std::uint64_t bytes = _run_bytes;
+        _run_bytes = 0;
+        return bytes;
+    }
+};
+
+/// @brief reads back one run written by RunEncoder
+class RunDecoder {
+private:
+    std::unique_ptr<AsyncReader> _in;
+    RunCodec _codec;
+    std::vector<int> _values;
+    std::vector<unsigned char> _bytes;
+    std::size_t _pos;
+
+    bool Refill() {
+        std::uint32_t header[2];
+        if (!_in->Read(header[0]) || !_in->Read(header[1])) {
+            return false;
+        }
+        _bytes.resize(header[0]);
+        _in->Read((char*)_bytes.data(), header[0]);
+        _values.resize(header[1]);
+        const unsigned char* p = _bytes.data();
+        std::memcpy(&_values[0], p, sizeof(int));
+        p += sizeof(int);
+        std::uint32_t previous = static_cast<std::uint32_t>(_values[0]);
+        for (std::size_t i = 1; i < _values.size(); ++i) {
+            std::uint32_t delta = 0;
+            unsigned shift = 0;
+            while (*p & 0x80) {
+                delta |= static_cast<std::uint32_t>(*p++ & 0x7f) << shift;
+                shift += 7;
+            }
+            delta |= static_cast<std::uint32_t>(*p++) << shift;
+            previous += delta;
+            _values[i] = static_cast<int>(previous);
+        }
+        _pos = 0;
+        return true;
+    }
+
+public:
+    RunDecoder(std::unique_ptr<AsyncReader> in, RunCodec codec) : _in(std::move(in)), _codec(codec), _pos(0) {}
+
+    bool Read(int& value) {
+        if (_codec == RunCodec::None) {
+            return _in->Read(value);
+        }
+        if (_pos == _values.size() && !Refill()) {
+            return false;
+        }
+        value = _values[_pos++];
+        return true;
+    }
+
+    /// @brief reads up to n ints, returns fewer only at the end of the run
+    std::size_t Read(int* data, std::size_t n) {
+        if (_codec == RunCodec::None) {
+            return _in->Read((char*)data, sizeof(int) * n) / sizeof(int);
+        }
+        std::size_t done = 0;
+        while (done < n && (_pos < _values.size() || Refill())) {
+            std::size_t c = std::min(n - done, _values.size() - _pos);
+            std::memcpy(data + done, &_values[_pos], sizeof(int) * c);
+            _pos += c;
+            done += c;
+        }
+        return done;
+    }
+};
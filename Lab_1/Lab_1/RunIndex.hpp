@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// @brief position of one sorted run inside a run file
+struct RunInfo {
+    std::uint64_t offset; // bytes from the start of the file
+    std::uint64_t length; // records
+    std::uint64_t bytes;  // size on disk, smaller than length * sizeof(int) when the run is compressed
+    std::uint64_t volume; // temp volume holding the run; the file on volume 0 is the one the index belongs to
+};
+
+/// @brief the run index of `file` is kept next to it in `file`.idx as a plain array of RunInfo
+inline std::string RunIndexName(const std::string& file) {
+    return file + ".idx";
+}
+
+inline void SaveRunIndex(const std::string& file, const std::vector<RunInfo>& runs) {
+    std::ofstream index(RunIndexName(file), std::ios::binary | std::ios::trunc);
+    index.write((const char*)runs.data(), sizeof(RunInfo) * runs.size());
+}
+
+/// @brief returns false when `file` has no index
+inline bool LoadRunIndex(const std::string& file, std::vector<RunInfo>& runs) {
+    std::ifstream index(RunIndexName(file), std::ios::binary | std::ios::ate);
+    if (!index) {
+        return false;
+    }
+    runs.resize(static_cast<std::size_t>(index.tellg()) / sizeof(RunInfo));
+    index.seekg(0);
+    index.read((char*)runs.data(), sizeof(RunInfo) * runs.size());
+    return true;
+}
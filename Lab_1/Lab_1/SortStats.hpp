@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// @brief one merge pass (a polyphase phase, a DirectOuterSort split + merge round)
+struct PassStats {
+    std::uint64_t runsIn = 0;
+    std::uint64_t runsOut = 0;
+    std::uint64_t records = 0;
+    double seconds = 0;
+    double ioWaitSeconds = 0; // time the sorter was blocked on the disk; the rest of `seconds` is CPU
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t comparisons = 0;
+};
+
+/// @brief what a sort did so far. Phases the sorter doesn't have stay at zero.
+struct SortStats {
+    std::uint64_t records = 0;
+    std::uint64_t runs = 0; // produced by the presort
+    double convertSeconds = 0;
+    double presortSeconds = 0;
+    double mergeSeconds = 0;
+    double outputSeconds = 0;
+    double ioWaitSeconds = 0;
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t comparisons = 0; // merge comparisons only, the presort kernels aren't instrumented
+    std::vector<PassStats> passes;
+
+    double TotalSeconds() const {
+        return convertSeconds + presortSeconds + mergeSeconds + outputSeconds;
+    }
+
+    double CpuSeconds() const {
+        return TotalSeconds() > ioWaitSeconds ? TotalSeconds() - ioWaitSeconds : 0;
+    }
+};
+
+/// @brief passed to the progress callback
+struct SortProgress {
+    std::string phase;          // "convert", "presort", "merge", "output"
+    unsigned pass;              // merge pass, counted from 1, 0 outside the merge
+    std::uint64_t records;      // done in this phase / pass
+    std::uint64_t totalRecords; // 0 while unknown
+    double elapsed;             // seconds since the sort started
+};
+
+using ProgressCallback = std::function<void(const SortProgress&)>;
+
+/// @brief rate-limits a progress callback: Report() is cheap to call often and fires at most once per interval
+class ProgressReporter {
+private:
+    ProgressCallback _callback;
+    std::chrono::steady_clock::duration _interval;
+    std::chrono::steady_clock::time_point _start, _last;
+
+public:
+    ProgressReporter() : _interval(std::chrono::seconds(1)) {}
+
+    void Set(ProgressCallback callback, std::chrono::milliseconds interval) {
+        _callback = std::move(callback);
+        _interval = interval;
+    }
+
+    void Start() {
+        _start = _last = std::chrono::steady_clock::now();
+    }
+
+    void Report(const std::string& phase, unsigned pass, std::uint64_t records, std::uint64_t totalRecords) {
+        if (!_callback) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - _last < _interval) {
+            return;
+        }
+        _last = now;
+        _callback({ phase, pass, records, totalRecords, std::chrono::duration<double>(now - _start).count() });
+    }
+};
+
+/// @brief comparator that counts its calls, for the merge statistics
+template <typename T>
+struct CountingLess {
+    std::uint64_t* count;
+
+    bool operator()(const T& a, const T& b) const {
+        ++*count;
+        return a < b;
+    }
+};
+
+inline void WriteStatsJson(const SortStats& stats, std::ostream& out) {
+    out << "{\n"
+        << "  \"records\": " << stats.records << ",\n"
+        << "  \"runs\": " << stats.runs << ",\n"
+        << "  \"convert_seconds\": " << stats.convertSeconds << ",\n"
+        << "  \"presort_seconds\": " << stats.presortSeconds << ",\n"
+        << "  \"merge_seconds\": " << stats.mergeSeconds << ",\n"
+        << "  \"output_seconds\": " << stats.outputSeconds << ",\n"
+        << "  \"io_wait_seconds\": " << stats.ioWaitSeconds << ",\n"
+        << "  \"cpu_seconds\": " << stats.CpuSeconds() << ",\n"
+        << "  \"bytes_read\": " << stats.bytesRead << ",\n"
+        << "  \"bytes_written\": " << stats.bytesWritten << ",\n"
+        << "  \"comparisons\": " << stats.comparisons << ",\n"
+        << "  \"passes\": [";
+    for (std::size_t i = 0; i < stats.passes.size(); ++i) {
+        const PassStats& pass = stats.passes[i];
+        out << (i > 0 ? "," : "") << "\n    {\"runs_in\": " << pass.runsIn << ", \"runs_out\": " << pass.runsOut
+            << ", \"records\": " << pass.records << ", \"seconds\": " << pass.seconds
+            << ", \"io_wait_seconds\": " << pass.ioWaitSeconds
+            << ", \"bytes_read\": " << pass.bytesRead << ", \"bytes_written\": " << pass.bytesWritten
+            << ", \"comparisons\": " << pass.comparisons << "}";
+    }
+    out << (stats.passes.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ModifiedOuterSort.hpp"
+
+/// @brief in-process sorter: Push() records, Finish(), then pull them back in order with Pull() or a
+/// range-for loop. Records are kept in memory up to the budget; only when it overflows is the buffer
+/// sorted and spilled as a run, and the runs are merged back on the fly while the caller pulls.
+/// Configure Sorter() (kernel, codec, temp directories) before the first Push().
+class StreamSorter {
+private:
+    ModifiedOuterSort _sorter;
+    std::size_t _budget;
+    std::vector<int> _buffer;
+    std::size_t _capacity;
+    bool _finished;
+    std::string _file;
+    std::unique_ptr<RunMerger> _merge;
+    std::size_t _pos;
+
+    void Spill() {
+        if (_file.empty()) {
+            _file = _sorter.TempFile("A.bin");
+            _sorter.BeginRuns(_file);
+        }
+        _sorter.SpillRun(_buffer.data(), _buffer.size());
+        _buffer.clear();
+    }
+
+public:
+    class Iterator {
+    private:
+        StreamSorter* _owner;
+        int _value;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        explicit Iterator(StreamSorter* owner = nullptr) : _owner(owner), _value(0) {
+            if (_owner != nullptr) {
+                ++*this;
+            }
+        }
+
+        reference operator*() const {
+            return _value;
+        }
+
+        Iterator& operator++() {
+            if (!_owner->Pull(_value)) {
+                _owner = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return _owner == other._owner;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return _owner != other._owner;
+        }
+    };
+
+    explicit StreamSorter(std::size_t memoryBudget = sizeof(int) * CHUNK_SIZE)
+        : _sorter(CHUNK_SIZE, memoryBudget), _budget(memoryBudget), _capacity(0), _finished(false), _pos(0) {}
+
+    ModifiedOuterSort& Sorter() {
+        return _sorter;
+    }
+
+    void Push(int value) {
+        if (_finished) {
+            throw std::logic_error("StreamSorter: Push after Finish");
+        }
+        if (_capacity == 0) {
+            // the radix kernel sorts through a scratch buffer of the same size; tiny budgets get one codec block
+            // so the merge never has to juggle millions of single-record runs
+            std::size_t perRecord = sizeof(int) * (_sorter.Kernel() == SortKernel::Radix ? 2 : 1);
+            _capacity = std::max<std::size_t>(_budget / perRecord, RUN_CODEC_BLOCK);
+            _buffer.reserve(_capacity);
+        }
+        if (_buffer.size() == _capacity) {
+            Spill();
+        }
+        _buffer.push_back(value);
+    }
+
+    void Push(const int* data, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            Push(data[i]);
+        }
+    }
+
+    void Push(const std::vector<int>& records) {
+        Push(records.data(), records.size());
+    }
+
+    // ends the input; if anything was spilled, the buffer memory goes back to the merge
+    void Finish() {
+        if (_finished) {
+            return;
+        }
+        _finished = true;
+        if (_file.empty()) {
+            _sorter.SortRun(_buffer.data(), _buffer.size());
+            return;
+        }
+        if (!_buffer.empty()) {
+            Spill();
+        }
+        std::vector<int>().swap(_buffer);
+        _sorter.EndRuns();
+        _merge = _sorter.OpenMerge(_sorter.ReduceRuns(_file));
+    }
+
+    // next record in order; false once all are out
+    bool Pull(int& value) {
+        Finish();
+        if (_merge) {
+            return _merge->Next(value);
+        }
+        if (_pos == _buffer.size()) {
+            return false;
+        }
+        value = _buffer[_pos++];
+        return true;
+    }
+
+    // up to n records in order, fewer only at the end
+    std::size_t Pull(int* data, std::size_t n) {
+        std::size_t done = 0;
+        while (done < n && Pull(data[done])) {
+            ++done;
+        }
+        return done;
+    }
+
+    // finishes the input if needed; the records can be iterated only once
+    Iterator begin() {
+        return Iterator(this);
+    }
+
+    Iterator end() {
+        return Iterator();
+    }
+};
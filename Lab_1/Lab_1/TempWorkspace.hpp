@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/// @brief private temp directories of one sort job: a fresh extsort-<random> directory is created on every
+/// volume, so several sorts can share a working directory, and all of them are removed with the workspace.
+/// Volume 0 is the primary one; the others are used to stripe runs over several devices.
+class TempWorkspace {
+private:
+    std::vector<std::filesystem::path> _dirs;
+
+    static std::string UniqueName() {
+        static std::random_device rd;
+        std::uint64_t salt = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        std::mt19937_64 gen((static_cast<std::uint64_t>(rd()) << 32) ^ rd() ^ salt);
+        std::ostringstream name;
+        name << "extsort-" << std::hex << gen();
+        return name.str();
+    }
+
+public:
+    explicit TempWorkspace(const std::vector<std::string>& volumes = { "." }) {
+        for (const std::string& volume : volumes.empty() ? std::vector<std::string>{ "." } : volumes) {
+            std::filesystem::path dir;
+            do {
+                dir = std::filesystem::path(volume) / UniqueName();
+            } while (!std::filesystem::create_directories(dir));
+            _dirs.push_back(dir);
+        }
+    }
+
+    TempWorkspace(const TempWorkspace&) = delete;
+    TempWorkspace& operator=(const TempWorkspace&) = delete;
+
+    ~TempWorkspace() {
+        for (const auto& dir : _dirs) {
+            std::error_code ec;
+            std::filesystem::remove_all(dir, ec);
+        }
+    }
+
+    std::size_t Volumes() const {
+        return _dirs.size();
+    }
+
+    std::string Path(const std::string& name, std::size_t volume = 0) const {
+        return (_dirs[volume % _dirs.size()] / name).string();
+    }
+};
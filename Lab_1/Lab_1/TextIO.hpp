@@ -0,0 +1,80 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "AsyncIO.hpp"
+
+/// @brief longest formatted int plus the line break
+constexpr std::size_t MAX_INT_TEXT = 12;
+
+/// @brief parses one line the way std::stoi does: leading blanks and '+' are accepted, anything after the
+/// number (e.g. '\r') is ignored. Returns false for a blank line, throws like stoi on garbage.
+inline bool ParseIntLine(const char* first, const char* last, int& value) {
+    while (first != last && (*first == ' ' || *first == '\t' || *first == '\r')) {
+        ++first;
+    }
+    if (first == last) {
+        return false;
+    }
+    if (*first == '+' && last - first > 1 && first[1] != '-') {
+        ++first;
+    }
+    auto result = std::from_chars(first, last, value);
+    if (result.ec == std::errc::invalid_argument) {
+        throw std::invalid_argument("ParseIntLine: " + std::string(first, last));
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("ParseIntLine: " + std::string(first, last));
+    }
+    return true;
+}
+
+/// @brief scans the reader block by block for line breaks and passes every parsed int to sink(int).
+/// Only a line split across two blocks is copied.
+template <typename Sink>
+void ParseIntLines(AsyncReader& reader, Sink&& sink) {
+    std::string carry;
+    const char* data;
+    std::size_t size;
+    int value;
+    while (reader.ReadBlock(data, size)) {
+        const char* end = data + size;
+        const char* line = data;
+        const char* nl = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!carry.empty()) {
+            if (nl == nullptr) {
+                carry.append(line, end);
+                continue;
+            }
+            carry.append(line, nl);
+            if (ParseIntLine(carry.data(), carry.data() + carry.size(), value)) {
+                sink(value);
+            }
+            carry.clear();
+            line = nl + 1;
+            nl = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        }
+        while (nl != nullptr) {
+            if (ParseIntLine(line, nl, value)) {
+                sink(value);
+            }
+            line = nl + 1;
+            nl = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        }
+        carry.assign(line, end);
+    }
+    if (!carry.empty() && ParseIntLine(carry.data(), carry.data() + carry.size(), value)) {
+        sink(value);
+    }
+}
+
+/// @brief writes value and '\n' at out, which must have MAX_INT_TEXT bytes of room; returns the new end
+inline char* FormatIntLine(char* out, int value) {
+    char* end = std::to_chars(out, out + MAX_INT_TEXT, value).ptr;
+    *end++ = '\n';
+    return end;
+}
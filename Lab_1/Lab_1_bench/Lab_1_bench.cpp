@@ -0,0 +1,354 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+#include "DirectOuterSort.hpp"
+#include "ModifiedOuterSort.hpp"
+
+// Generates inputs of the chosen sizes and distributions, sorts them with both sorters and reports
+// wall time, throughput, merge passes and bytes moved per phase, as a table and optionally CSV/JSON:
+//
+//   Lab_1_bench --records 1000000,10000000 --dist uniform,zipf --budget 256 --csv bench.csv --json bench.json
+//
+// Every run's output is checked to be sorted and complete, so a broken build can't post a good time.
+
+struct BenchOptions {
+    std::vector<std::uint64_t> records = { 1'000'000 };
+    std::vector<std::string> distributions = { "uniform", "presorted", "reverse", "duplicates", "zipf", "nearly-sorted" };
+    std::vector<std::string> sorters = { "direct", "modified" };
+    std::uint64_t directLimit = 100'000; // DirectOuterSort does log2(n) text passes, skip it above this size
+    std::size_t budget = 0;               // MiB, 0 - default chunk size
+    RunGeneration runGeneration = RunGeneration::Chunks;
+    SortKernel kernel = SortKernel::Std;
+    RunCodec codec = RunCodec::None;
+    MergeStrategy strategy = MergeStrategy::Balanced;
+    unsigned tapes = 3;
+    std::string temp = ".";
+    std::string csv, json;
+    unsigned seed = 42;
+};
+
+struct BenchRow {
+    std::string sorter;
+    std::string distribution;
+    std::uint64_t records;
+    std::string phase;
+    double seconds;
+    unsigned passes;
+    std::uint64_t bytesRead;
+    std::uint64_t bytesWritten;
+    bool sorted;
+
+    double MBps() const {
+        return seconds > 0 ? (bytesRead + bytesWritten) / seconds / 1e6 : 0;
+    }
+};
+
+// fills block[0, n) with records first, first + 1, ... of an input of `total` records
+using Generator = std::function<void(std::uint64_t first, int* block, std::size_t n)>;
+
+Generator MakeGenerator(const std::string& name, std::uint64_t total, unsigned seed) {
+    auto gen = std::make_shared<std::mt19937_64>(seed);
+    // evenly spaced ascending values over the whole int range
+    auto ascending = [total](std::uint64_t i) {
+        return static_cast<int>(INT32_MIN + static_cast<std::int64_t>((i * 4294967295.0) / std::max<std::uint64_t>(total, 1)));
+    };
+
+    if (name == "uniform") {
+        return [gen](std::uint64_t, int* block, std::size_t n) {
+            std::uniform_int_distribution<int> value(INT32_MIN, INT32_MAX);
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = value(*gen);
+            }
+        };
+    }
+    if (name == "presorted") {
+        return [ascending](std::uint64_t first, int* block, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = ascending(first + i);
+            }
+        };
+    }
+    if (name == "reverse") {
+        return [ascending, total](std::uint64_t first, int* block, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = ascending(total - 1 - (first + i));
+            }
+        };
+    }
+    if (name == "duplicates") {
+        return [gen](std::uint64_t, int* block, std::size_t n) {
+            std::uniform_int_distribution<int> value(0, 99);
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = value(*gen);
+            }
+        };
+    }
+    if (name == "zipf") {
+        // rank r of 2^20 values is drawn with probability ~ 1 / r
+        auto cdf = std::make_shared<std::vector<double>>(1 << 20);
+        double sum = 0;
+        for (std::size_t r = 0; r < cdf->size(); ++r) {
+            sum += 1.0 / (r + 1);
+            (*cdf)[r] = sum;
+        }
+        return [gen, cdf, sum](std::uint64_t, int* block, std::size_t n) {
+            std::uniform_real_distribution<double> u(0, sum);
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = static_cast<int>(std::lower_bound(cdf->begin(), cdf->end(), u(*gen)) - cdf->begin());
+            }
+        };
+    }
+    if (name == "nearly-sorted") {
+        // ascending, with 1% of the records swapped with a neighbour up to 64 places away
+        return [gen, ascending](std::uint64_t first, int* block, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = ascending(first + i);
+            }
+            if (n < 2) {
+                return;
+            }
+            std::uniform_int_distribution<std::size_t> position(0, n - 1), distance(1, 64);
+            for (std::size_t s = 0; s < n / 100; ++s) {
+                std::size_t i = position(*gen);
+                std::size_t j = std::min(n - 1, i + distance(*gen));
+                std::swap(block[i], block[j]);
+            }
+        };
+    }
+    throw std::invalid_argument("unknown distribution: " + name);
+}
+
+void GenerateInput(const Generator& generator, std::uint64_t records, const std::string& file) {
+    AsyncWriter out(file, IO_BLOCK_SIZE);
+    std::vector<int> block(1 << 16);
+    std::vector<char> text(MAX_INT_TEXT * block.size());
+    for (std::uint64_t first = 0; first < records; first += block.size()) {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), records - first));
+        generator(first, block.data(), n);
+        char* end = text.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            end = FormatIntLine(end, block[i]);
+        }
+        out.Write(text.data(), end - text.data());
+    }
+    out.Close();
+}
+
+// the output must hold `records` numbers in non-decreasing order
+bool CheckSorted(const std::string& file, std::uint64_t records) {
+    AsyncReader in(file, IO_BLOCK_SIZE);
+    std::uint64_t count = 0;
+    bool sorted = true;
+    int previous = INT32_MIN;
+    ParseIntLines(in, [&](int value) {
+        sorted = sorted && value >= previous;
+        previous = value;
+        ++count;
+    });
+    return sorted && count == records;
+}
+
+double Since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RunDirect(const BenchOptions& options, const std::string& distribution, std::uint64_t records,
+               const std::string& input, const std::string& output, std::vector<BenchRow>& rows) {
+    DirectOuterSort sorter(options.temp);
+    auto start = std::chrono::steady_clock::now();
+    sorter.Sort(input, output);
+    double seconds = Since(start);
+    rows.push_back({ "direct", distribution, records, "total", seconds, sorter.Passes(), sorter.BytesRead(),
+                     sorter.BytesWritten(), CheckSorted(output, records) });
+}
+
+void RunModified(const BenchOptions& options, const std::string& distribution, std::uint64_t records,
+                 const std::string& input, const std::string& output, std::vector<BenchRow>& rows) {
+    ModifiedOuterSort sorter(CHUNK_SIZE);
+    sorter.SetTempDirectories({ options.temp });
+    sorter.SetRunGeneration(options.runGeneration);
+    sorter.SetSortKernel(options.kernel);
+    sorter.SetRunCodec(options.codec);
+    sorter.SetMergeStrategy(options.strategy, options.tapes);
+    if (options.budget > 0) {
+        sorter.AutoTune(options.budget << 20, input);
+    }
+
+    std::size_t first = rows.size();
+    auto phase = [&](const std::string& name, const std::function<void()>& body) {
+        unsigned passes = sorter.MergePasses();
+        std::uint64_t read = sorter.BytesRead(), written = sorter.BytesWritten();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double seconds = Since(start);
+        rows.push_back({ "modified", distribution, records, name, seconds, sorter.MergePasses() - passes,
+                         sorter.BytesRead() - read, sorter.BytesWritten() - written, true });
+    };
+    std::string binary = sorter.TempFile("B.bin"), runs = sorter.TempFile("A.bin"), sorted;
+    phase("convert", [&] { sorter.ConvertStringToInt(input, binary); });
+    phase("presort", [&] { sorter.Preparation(binary, runs); });
+    phase("merge", [&] { sorted = sorter.Sort(runs); });
+    phase("output", [&] { sorter.PostWrite(sorted, output); });
+
+    BenchRow total{ "modified", distribution, records, "total", 0, 0, 0, 0, CheckSorted(output, records) };
+    for (std::size_t i = first; i < rows.size(); ++i) {
+        total.seconds += rows[i].seconds;
+        total.passes += rows[i].passes;
+        total.bytesRead += rows[i].bytesRead;
+        total.bytesWritten += rows[i].bytesWritten;
+        rows[i].sorted = total.sorted;
+    }
+    rows.push_back(total);
+}
+
+void PrintTable(const std::vector<BenchRow>& rows, std::ostream& out) {
+    out << "sorter    distribution   records      phase    seconds     MB/s  passes    MiB read MiB written  ok\n";
+    for (const BenchRow& row : rows) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-9s %-14s %-12llu %-8s %8.3f %8.1f %7u %11.1f %11.1f  %s\n",
+                      row.sorter.c_str(), row.distribution.c_str(), static_cast<unsigned long long>(row.records),
+                      row.phase.c_str(), row.seconds, row.MBps(), row.passes, row.bytesRead / 1048576.0,
+                      row.bytesWritten / 1048576.0, row.sorted ? "yes" : "NO");
+        out << line;
+    }
+}
+
+void WriteCsv(const std::vector<BenchRow>& rows, std::ostream& out) {
+    out << "sorter,distribution,records,phase,seconds,mb_per_s,passes,bytes_read,bytes_written,sorted\n";
+    for (const BenchRow& row : rows) {
+        out << row.sorter << ',' << row.distribution << ',' << row.records << ',' << row.phase << ','
+            << row.seconds << ',' << row.MBps() << ',' << row.passes << ',' << row.bytesRead << ','
+            << row.bytesWritten << ',' << (row.sorted ? "true" : "false") << '\n';
+    }
+}
+
+void WriteJson(const std::vector<BenchRow>& rows, std::ostream& out) {
+    out << "[\n";
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const BenchRow& row = rows[i];
+        out << "  {\"sorter\": \"" << row.sorter << "\", \"distribution\": \"" << row.distribution
+            << "\", \"records\": " << row.records << ", \"phase\": \"" << row.phase
+            << "\", \"seconds\": " << row.seconds << ", \"mb_per_s\": " << row.MBps()
+            << ", \"passes\": " << row.passes << ", \"bytes_read\": " << row.bytesRead
+            << ", \"bytes_written\": " << row.bytesWritten << ", \"sorted\": " << (row.sorted ? "true" : "false")
+            << "}" << (i + 1 < rows.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    for (std::string item; std::getline(in, item, ',');) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+void PrintUsage() {
+    std::cout << "Usage: Lab_1_bench [options]\n"
+                 "  --records N[,N...]    input sizes (default 1000000)\n"
+                 "  --dist LIST           uniform,presorted,reverse,duplicates,zipf,nearly-sorted (default all)\n"
+                 "  --sorters LIST        direct,modified (default both)\n"
+                 "  --direct-limit N      skip DirectOuterSort above N records (default 100000)\n"
+                 "  --budget MiB          memory budget for ModifiedOuterSort (default: fixed chunk size)\n"
+                 "  --presort chunks|rs   run generation\n"
+                 "  --kernel std|radix    chunk sort kernel\n"
+                 "  --codec none|dv       intermediate run format\n"
+                 "  --polyphase TAPES     polyphase merge instead of the balanced one\n"
+                 "  --temp DIR            temp directory\n"
+                 "  --seed N              generator seed\n"
+                 "  --csv FILE, --json FILE  also write the results there\n";
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string name = argv[i];
+        if (name == "--help" || i + 1 == argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (name == "--records") {
+            options.records.clear();
+            for (const std::string& item : SplitList(value)) {
+                options.records.push_back(std::stoull(item));
+            }
+        } else if (name == "--dist") {
+            options.distributions = SplitList(value);
+        } else if (name == "--sorters") {
+            options.sorters = SplitList(value);
+        } else if (name == "--direct-limit") {
+            options.directLimit = std::stoull(value);
+        } else if (name == "--budget") {
+            options.budget = std::stoull(value);
+        } else if (name == "--presort") {
+            options.runGeneration = value == "rs" ? RunGeneration::ReplacementSelection : RunGeneration::Chunks;
+        } else if (name == "--kernel") {
+            options.kernel = value == "radix" ? SortKernel::Radix : SortKernel::Std;
+        } else if (name == "--codec") {
+            options.codec = value == "dv" ? RunCodec::DeltaVarint : RunCodec::None;
+        } else if (name == "--polyphase") {
+            options.strategy = MergeStrategy::Polyphase;
+            options.tapes = static_cast<unsigned>(std::stoul(value));
+        } else if (name == "--temp") {
+            options.temp = value;
+        } else if (name == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else if (name == "--csv") {
+            options.csv = value;
+        } else if (name == "--json") {
+            options.json = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    TempWorkspace workspace({ options.temp });
+    std::string input = workspace.Path("input.txt"), output = workspace.Path("sorted.txt");
+    std::vector<BenchRow> rows;
+    for (std::uint64_t records : options.records) {
+        for (const std::string& distribution : options.distributions) {
+            std::cerr << "Generating " << records << " " << distribution << " records\n";
+            GenerateInput(MakeGenerator(distribution, records, options.seed), records, input);
+            for (const std::string& sorter : options.sorters) {
+                if (sorter == "direct" && records <= options.directLimit) {
+                    RunDirect(options, distribution, records, input, output, rows);
+                } else if (sorter == "modified") {
+                    RunModified(options, distribution, records, input, output, rows);
+                }
+            }
+        }
+    }
+
+    PrintTable(rows, std::cout);
+    if (!options.csv.empty()) {
+        std::ofstream csv(options.csv, std::ios::trunc);
+        WriteCsv(rows, csv);
+    }
+    if (!options.json.empty()) {
+        std::ofstream json(options.json, std::ios::trunc);
+        WriteJson(rows, json);
+    }
+    return std::all_of(rows.begin(), rows.end(), [](const BenchRow& row) { return row.sorted; }) ? 0 : 2;
+}